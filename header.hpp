@@ -12,6 +12,19 @@ template<typename _Stream> core::string<iu8f> useInputStream (iterators::InputSt
 template<typename _Stream> void checkEq (bool eq, iterators::InputStreamIterator<_Stream> &r_i, const iterators::InputStreamEndIterator<_Stream> &end0, iterators::InputStreamIterator<_Stream> &r_end1);
 void testOutputStreamIterator ();
 template<typename _Stream> void useOutputStream (iterators::OutputStreamIterator<_Stream> &r_i, core::string<iu8f> data);
+core::string<iu8f> makeTestData (size_t size);
+int makeTempFile ();
+core::string<iu8f> readAll (int fd);
+core::string<iu8f> readRest (int fd);
+void testPump ();
+template<typename _InputStream, typename _OutputStream> void usePump (_InputStream &r_inStream, _OutputStream &r_outStream, size_t bufferCapacity, const core::string<iu8f> &data, size_t preReadCount);
+void testUringStreams ();
+void testDirectFdStreams ();
+void testAsyncStreams ();
+iterators::AsyncTask writeAsync (iterators::EpollExecutor &r_executor, int fd, const core::string<iu8f> &data, bool duplex);
+iterators::AsyncTask readAsync (iterators::EpollExecutor &r_executor, int fd, core::string<iu8f> &r_data, bool duplex);
+void testFrameReader ();
+void testSeekableStreamIterator ();
 void testRevaluedIterator ();
 template<typename _Iterator> void useRevaluedRandomAccessIterator (_Iterator begin, _Iterator end, const char *expectedData);
 
@@ -1,4 +1,17 @@
 #include "iterators.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 LIB_DEPENDENCIES
 
@@ -10,14 +23,27 @@ DC();
 
 iu8f *const BufferedWindow::endedMarker = static_cast<iu8f *>(nullptr) + 1;
 
-BufferedWindow::BufferedWindow (size_t capacity_) {
+void BufferedWindow::Deleter::operator() (iu8f *b) const noexcept {
+  free(b);
+}
+
+BufferedWindow::BufferedWindow (size_t capacity_, size_t alignment) {
   DPRE(capacity_ != 0);
-  b.reset(new iu8f[capacity_]);
+  DPRE(alignment != 0 && (alignment & (alignment - 1)) == 0, "alignment must be a power of two");
+  void *p;
+  int e = posix_memalign(&p, std::max(alignment, sizeof(void *)), capacity_);
+  if (e != 0) {
+    throw std::bad_alloc();
+  }
+  b.reset(static_cast<iu8f *>(p));
   capacity = capacity_;
   i = b.get();
   end = i;
 }
 
+BufferedWindow::BufferedWindow (size_t capacity) : BufferedWindow(capacity, alignof(std::max_align_t)) {
+}
+
 BufferedWindow::BufferedWindow () noexcept {
   capacity = 0;
   i = endedMarker;
@@ -90,6 +116,967 @@ iu8f *BufferedWindow::operator++ (int) noexcept {
   return i++;
 }
 
+tuple<iu8f *, size_t> BufferedWindow::getRemainder () noexcept {
+  if (ended()) {
+    return tuple<iu8f *, size_t>(nullptr, 0);
+  }
+  return tuple<iu8f *, size_t>(i, offset(i, end));
+}
+
+void BufferedWindow::advance (size_t size) noexcept {
+  DPRE(!ended(), "this must not have ended");
+  DPRE(size <= offset(i, end), "size must be no greater than the size of the remainder");
+  i += size;
+}
+
+void BufferedWindow::compact () noexcept {
+  DPRE(!ended(), "this must not have ended");
+  size_t size = offset(i, end);
+  memmove(b.get(), i, size);
+  i = b.get();
+  end = i + size;
+}
+
+tuple<iu8f *, size_t> BufferedWindow::getSpare () noexcept {
+  if (ended()) {
+    return tuple<iu8f *, size_t>(nullptr, 0);
+  }
+  return tuple<iu8f *, size_t>(end, capacity - offset(b.get(), end));
+}
+
+void BufferedWindow::extend (size_t size) noexcept {
+  DPRE(!ended(), "this must not have ended");
+  DPRE(size <= capacity - offset(b.get(), end), "size must be no greater than the size of the spare space");
+  end += size;
+}
+
+[[noreturn]] static void throwErrno () {
+  throw std::system_error(errno, std::generic_category());
+}
+
+FdInputStream::FdInputStream (int fd) noexcept : fd(fd) {
+}
+
+int FdInputStream::getFd () const noexcept {
+  return fd;
+}
+
+size_t FdInputStream::read (iu8f *b, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+
+  while (true) {
+    ssize_t r = ::read(fd, b, size);
+    if (r == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throwErrno();
+    }
+    if (r == 0) {
+      return numeric_limits<size_t>::max();
+    }
+    return static_cast<size_t>(r);
+  }
+}
+
+FdOutputStream::FdOutputStream (int fd) noexcept : fd(fd) {
+}
+
+int FdOutputStream::getFd () const noexcept {
+  return fd;
+}
+
+void FdOutputStream::write (const iu8f *b, size_t size) {
+  while (size != 0) {
+    ssize_t r = ::write(fd, b, size);
+    if (r == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throwErrno();
+    }
+    b += r;
+    size -= static_cast<size_t>(r);
+  }
+}
+
+FdSeekableInputStream::FdSeekableInputStream (int fd) : fd(fd) {
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    throwErrno();
+  }
+  totalSize = static_cast<iu64f>(st.st_size);
+}
+
+int FdSeekableInputStream::getFd () const noexcept {
+  return fd;
+}
+
+size_t FdSeekableInputStream::readAt (iu8f *b, size_t size, iu64f offset) {
+  size_t readSize = 0;
+  while (readSize != size) {
+    ssize_t r = pread(fd, b + readSize, size - readSize, static_cast<off_t>(offset + readSize));
+    if (r == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throwErrno();
+    }
+    if (r == 0) {
+      break;
+    }
+    readSize += static_cast<size_t>(r);
+  }
+  return readSize;
+}
+
+iu64f FdSeekableInputStream::getSize () const noexcept {
+  return totalSize;
+}
+
+size_t transfer (FdInputStream &r_in, FdOutputStream &r_out, size_t size) {
+  int inFd = r_in.getFd();
+  int outFd = r_out.getFd();
+  struct stat inStat, outStat;
+  int outFlags;
+  if (fstat(inFd, &inStat) == -1 || fstat(outFd, &outStat) == -1 || (outFlags = fcntl(outFd, F_GETFL)) == -1) {
+    throwErrno();
+  }
+
+  enum {
+    spliceMode,
+    copyFileRangeMode,
+    sendfileMode,
+    copyMode
+  } mode;
+  if (S_ISFIFO(inStat.st_mode) || S_ISFIFO(outStat.st_mode)) {
+    mode = spliceMode;
+  } else if (S_ISREG(outStat.st_mode) && (outFlags & O_APPEND) != 0) {
+    // Neither copy_file_range() nor sendfile() can write to a file in append mode.
+    mode = copyMode;
+  } else if (S_ISREG(inStat.st_mode) && S_ISREG(outStat.st_mode)) {
+    mode = copyFileRangeMode;
+  } else if (S_ISREG(inStat.st_mode) || S_ISBLK(inStat.st_mode)) {
+    mode = sendfileMode;
+  } else {
+    mode = copyMode;
+  }
+
+  const size_t blockCapacity = 1U << 30;
+  size_t moved = 0;
+  while (mode != copyMode && moved != size) {
+    size_t blockSize = min(size - moved, blockCapacity);
+    ssize_t r;
+    switch (mode) {
+      case spliceMode:
+        r = splice(inFd, nullptr, outFd, nullptr, blockSize, SPLICE_F_MOVE);
+        break;
+      case copyFileRangeMode:
+        r = copy_file_range(inFd, nullptr, outFd, nullptr, blockSize, 0);
+        break;
+      default:
+        r = sendfile(outFd, inFd, nullptr, blockSize);
+        break;
+    }
+
+    if (r == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EINVAL || errno == ENOSYS || errno == EXDEV || errno == EOPNOTSUPP) {
+        mode = mode == copyFileRangeMode ? sendfileMode : copyMode;
+        continue;
+      }
+      throwErrno();
+    }
+    if (r == 0) {
+      return moved;
+    }
+    moved += static_cast<size_t>(r);
+  }
+
+  return moved + transfer<FdInputStream, FdOutputStream>(r_in, r_out, size - moved);
+}
+
+/**
+  A minimal io_uring instance, with at most one operation in flight per entry.
+*/
+class IoUring {
+  prv int fd;
+  prv void *sqRing;
+  prv size_t sqRingSize;
+  prv void *cqRing;
+  prv size_t cqRingSize;
+  prv io_uring_sqe *sqes;
+  prv size_t sqesSize;
+  prv unsigned *sqHead;
+  prv unsigned *sqTail;
+  prv unsigned sqMask;
+  prv unsigned *sqArray;
+  prv unsigned *cqHead;
+  prv unsigned *cqTail;
+  prv unsigned cqMask;
+  prv io_uring_cqe *cqes;
+  prv unsigned unsubmittedCount;
+  prv bool fixedBuffers;
+
+  pub explicit IoUring (unsigned entryCount);
+  IoUring (const IoUring &) = delete;
+  IoUring &operator= (const IoUring &) = delete;
+  pub ~IoUring ();
+
+  prv void release () noexcept;
+  pub bool supports (iu8f opcode) const;
+  pub bool registerBuffers (std::vector<UringSlot> &r_slots) noexcept;
+  pub void push (iu8f opcode, int targetFd, iu8f *b, size_t size, iu64f offset, size_t bufferI, iu64f userData) noexcept;
+  pub tuple<iu64f, int> wait ();
+};
+
+IoUring::IoUring (unsigned entryCount) : fd(-1), sqRing(MAP_FAILED), cqRing(MAP_FAILED), sqes(static_cast<io_uring_sqe *>(MAP_FAILED)), unsubmittedCount(0), fixedBuffers(false) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  fd = static_cast<int>(syscall(__NR_io_uring_setup, entryCount, &params));
+  if (fd == -1) {
+    throwErrno();
+  }
+
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (singleMmap) {
+    sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+  }
+  sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+  sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (sqRing != MAP_FAILED) {
+    cqRing = singleMmap ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  }
+  if (cqRing != MAP_FAILED) {
+    sqes = static_cast<io_uring_sqe *>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+  }
+  if (sqes == MAP_FAILED) {
+    int e = errno;
+    release();
+    throw std::system_error(e, std::generic_category());
+  }
+
+  auto sqBase = static_cast<char *>(sqRing);
+  sqHead = reinterpret_cast<unsigned *>(sqBase + params.sq_off.head);
+  sqTail = reinterpret_cast<unsigned *>(sqBase + params.sq_off.tail);
+  sqMask = *reinterpret_cast<unsigned *>(sqBase + params.sq_off.ring_mask);
+  sqArray = reinterpret_cast<unsigned *>(sqBase + params.sq_off.array);
+  auto cqBase = static_cast<char *>(cqRing);
+  cqHead = reinterpret_cast<unsigned *>(cqBase + params.cq_off.head);
+  cqTail = reinterpret_cast<unsigned *>(cqBase + params.cq_off.tail);
+  cqMask = *reinterpret_cast<unsigned *>(cqBase + params.cq_off.ring_mask);
+  cqes = reinterpret_cast<io_uring_cqe *>(cqBase + params.cq_off.cqes);
+}
+
+IoUring::~IoUring () {
+  release();
+}
+
+void IoUring::release () noexcept {
+  if (sqes != MAP_FAILED) {
+    munmap(sqes, sqesSize);
+  }
+  if (cqRing != MAP_FAILED && cqRing != sqRing) {
+    munmap(cqRing, cqRingSize);
+  }
+  if (sqRing != MAP_FAILED) {
+    munmap(sqRing, sqRingSize);
+  }
+  if (fd != -1) {
+    close(fd);
+  }
+}
+
+bool IoUring::supports (iu8f opcode) const {
+  const unsigned opCapacity = 256;
+  std::unique_ptr<iu8f []> b(new iu8f[sizeof(io_uring_probe) + opCapacity * sizeof(io_uring_probe_op)]());
+  auto probe = reinterpret_cast<io_uring_probe *>(b.get());
+  // Probing is itself unsupported before Linux 5.6 (which is where the plain read and write ops were introduced).
+  if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, opCapacity) != 0) {
+    return false;
+  }
+  return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+}
+
+bool IoUring::registerBuffers (std::vector<UringSlot> &r_slots) noexcept {
+  std::vector<iovec> iovecs;
+  iovecs.reserve(r_slots.size());
+  for (UringSlot &slot : r_slots) {
+    auto v = slot.window.get();
+    iovecs.push_back(iovec{get<0>(v), get<1>(v)});
+  }
+  // If buffers can't be pinned (e.g. due to RLIMIT_MEMLOCK), plain reads and writes are used instead.
+  fixedBuffers = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iovecs.data(), static_cast<unsigned>(iovecs.size())) == 0;
+  return fixedBuffers;
+}
+
+void IoUring::push (iu8f opcode, int targetFd, iu8f *b, size_t size, iu64f offset, size_t bufferI, iu64f userData) noexcept {
+  unsigned tail = *sqTail;
+  DA(tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) <= sqMask);
+  unsigned entryI = tail & sqMask;
+  io_uring_sqe &sqe = sqes[entryI];
+  memset(&sqe, 0, sizeof(sqe));
+  if (fixedBuffers) {
+    sqe.opcode = opcode;
+    sqe.buf_index = static_cast<__u16>(bufferI);
+  } else {
+    sqe.opcode = opcode == IORING_OP_READ_FIXED ? IORING_OP_READ : IORING_OP_WRITE;
+  }
+  sqe.fd = targetFd;
+  sqe.addr = reinterpret_cast<__u64>(b);
+  sqe.len = static_cast<__u32>(size);
+  sqe.off = offset;
+  sqe.user_data = userData;
+  sqArray[entryI] = entryI;
+  __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+  ++unsubmittedCount;
+}
+
+tuple<iu64f, int> IoUring::wait () {
+  while (true) {
+    unsigned head = *cqHead;
+    if (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+      io_uring_cqe &cqe = cqes[head & cqMask];
+      tuple<iu64f, int> r(cqe.user_data, cqe.res);
+      __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+      return r;
+    }
+
+    long r = syscall(__NR_io_uring_enter, fd, unsubmittedCount, 1U, IORING_ENTER_GETEVENTS, nullptr, 0);
+    if (r == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throwErrno();
+    }
+    unsubmittedCount -= static_cast<unsigned>(r);
+  }
+}
+
+static std::unique_ptr<IoUring> makeRing (int fd, size_t depth, size_t bufferCapacity, std::vector<UringSlot> &r_slots, iu64f &r_offset) {
+  DPRE(depth != 0);
+  DPRE(bufferCapacity != 0);
+  off_t offset = lseek(fd, 0, SEEK_CUR);
+  if (offset == -1) {
+    return nullptr;
+  }
+
+  std::unique_ptr<IoUring> ring;
+  try {
+    ring.reset(new IoUring(static_cast<unsigned>(depth)));
+  } catch (std::system_error &) {
+    return nullptr;
+  }
+  r_slots.reserve(depth);
+  for (size_t i = 0; i != depth; ++i) {
+    r_slots.push_back(UringSlot{BufferedWindow(bufferCapacity), 0, 0, 0, 0, false, false});
+  }
+  if (!ring->registerBuffers(r_slots) && !(ring->supports(IORING_OP_READ) && ring->supports(IORING_OP_WRITE))) {
+    r_slots.clear();
+    return nullptr;
+  }
+  r_offset = static_cast<iu64f>(offset);
+  return ring;
+}
+
+UringInputStream::UringInputStream (int fd, size_t depth, size_t bufferCapacity) : fd(fd), headSlotI(0), nextOffset(0) {
+  ring = makeRing(fd, depth, bufferCapacity, slots, nextOffset);
+  position = nextOffset;
+  if (ring) {
+    for (size_t i = 0; i != slots.size(); ++i) {
+      submit(i);
+    }
+  }
+}
+
+UringInputStream::~UringInputStream () {
+  if (!ring) {
+    return;
+  }
+
+  try {
+    for (UringSlot &slot : slots) {
+      while (slot.inFlight) {
+        complete();
+      }
+    }
+  } catch (std::system_error &) {
+    // The remaining operations will be cancelled when the ring is torn down.
+  }
+  lseek(fd, static_cast<off_t>(position), SEEK_SET);
+}
+
+void UringInputStream::submit (size_t slotI) {
+  UringSlot &slot = slots[slotI];
+  slot.offset = nextOffset;
+  slot.size = get<1>(slot.window.get());
+  slot.done = 0;
+  slot.error = 0;
+  slot.ended = false;
+  nextOffset += slot.size;
+  issue(slotI);
+}
+
+void UringInputStream::issue (size_t slotI) {
+  UringSlot &slot = slots[slotI];
+  DA(!slot.inFlight);
+  ring->push(IORING_OP_READ_FIXED, fd, get<0>(slot.window.get()) + slot.done, slot.size - slot.done, slot.offset + slot.done, slotI, slotI);
+  slot.inFlight = true;
+}
+
+void UringInputStream::complete () {
+  auto v = ring->wait();
+  size_t slotI = static_cast<size_t>(get<0>(v));
+  int res = get<1>(v);
+  UringSlot &slot = slots[slotI];
+  DA(slot.inFlight);
+  slot.inFlight = false;
+
+  if (res < 0) {
+    if (res == -EINTR || res == -EAGAIN) {
+      issue(slotI);
+      return;
+    }
+    slot.error = -res;
+    return;
+  }
+  if (res == 0) {
+    slot.ended = true;
+  } else {
+    slot.done += static_cast<size_t>(res);
+    if (slot.done != slot.size) {
+      issue(slotI);
+      return;
+    }
+  }
+  if (slot.done != 0) {
+    slot.window.reset(slot.done);
+  }
+}
+
+size_t UringInputStream::read (iu8f *b, size_t size) {
+  if (!ring) {
+    return FdInputStream(fd).read(b, size);
+  }
+  if (size == 0) {
+    return 0;
+  }
+
+  UringSlot &slot = slots[headSlotI];
+  while (slot.inFlight) {
+    complete();
+  }
+  if (slot.error != 0) {
+    // The read is retried on the next call.
+    int e = slot.error;
+    slot.error = 0;
+    issue(headSlotI);
+    throw std::system_error(e, std::generic_category());
+  }
+  if (slot.window.exhausted()) {
+    DA(slot.ended);
+    return numeric_limits<size_t>::max();
+  }
+
+  auto v = slot.window.getRemainder();
+  size = min(size, get<1>(v));
+  memcpy(b, get<0>(v), size);
+  slot.window.advance(size);
+  position += size;
+  if (slot.window.exhausted()) {
+    if (!slot.ended) {
+      submit(headSlotI);
+    }
+    headSlotI = (headSlotI + 1) % slots.size();
+  }
+  return size;
+}
+
+UringOutputStream::UringOutputStream (int fd, size_t depth, size_t bufferCapacity) : fd(fd), tailSlotI(0), nextOffset(0), error(0) {
+  ring = makeRing(fd, depth, bufferCapacity, slots, nextOffset);
+  for (UringSlot &slot : slots) {
+    slot.window.reset(get<1>(slot.window.get()));
+  }
+}
+
+UringOutputStream::~UringOutputStream () {
+  if (!ring) {
+    return;
+  }
+
+  try {
+    for (UringSlot &slot : slots) {
+      while (slot.inFlight) {
+        complete();
+      }
+    }
+  } catch (std::system_error &) {
+    // The remaining operations will be cancelled when the ring is torn down.
+  }
+}
+
+void UringOutputStream::submit (size_t slotI) {
+  UringSlot &slot = slots[slotI];
+  slot.offset = nextOffset;
+  slot.size = slot.window.advancement();
+  slot.done = 0;
+  nextOffset += slot.size;
+  issue(slotI);
+}
+
+void UringOutputStream::issue (size_t slotI) {
+  UringSlot &slot = slots[slotI];
+  DA(!slot.inFlight);
+  ring->push(IORING_OP_WRITE_FIXED, fd, get<0>(slot.window.get()) + slot.done, slot.size - slot.done, slot.offset + slot.done, slotI, slotI);
+  slot.inFlight = true;
+}
+
+void UringOutputStream::complete () {
+  auto v = ring->wait();
+  size_t slotI = static_cast<size_t>(get<0>(v));
+  int res = get<1>(v);
+  UringSlot &slot = slots[slotI];
+  DA(slot.inFlight);
+  slot.inFlight = false;
+
+  if (res < 0) {
+    if (res == -EINTR || res == -EAGAIN) {
+      issue(slotI);
+      return;
+    }
+    if (error == 0) {
+      error = -res;
+    }
+  } else {
+    slot.done += static_cast<size_t>(res);
+    if (slot.done != slot.size) {
+      if (res != 0) {
+        issue(slotI);
+        return;
+      }
+      if (error == 0) {
+        error = EIO;
+      }
+    }
+  }
+  slot.window.reset(get<1>(slot.window.get()));
+}
+
+void UringOutputStream::checkError () const {
+  if (error != 0) {
+    throw std::system_error(error, std::generic_category());
+  }
+}
+
+void UringOutputStream::write (const iu8f *b, size_t size) {
+  if (!ring) {
+    FdOutputStream(fd).write(b, size);
+    return;
+  }
+
+  checkError();
+  while (size != 0) {
+    UringSlot &slot = slots[tailSlotI];
+    while (slot.inFlight) {
+      complete();
+    }
+    checkError();
+
+    auto v = slot.window.getRemainder();
+    size_t blockSize = min(size, get<1>(v));
+    memcpy(get<0>(v), b, blockSize);
+    slot.window.advance(blockSize);
+    b += blockSize;
+    size -= blockSize;
+    if (slot.window.exhausted()) {
+      submit(tailSlotI);
+      tailSlotI = (tailSlotI + 1) % slots.size();
+    }
+  }
+}
+
+void UringOutputStream::flush () {
+  if (!ring) {
+    return;
+  }
+
+  checkError();
+  UringSlot &tailSlot = slots[tailSlotI];
+  if (!tailSlot.inFlight && tailSlot.window.advancement() != 0) {
+    submit(tailSlotI);
+    tailSlotI = (tailSlotI + 1) % slots.size();
+  }
+  for (UringSlot &slot : slots) {
+    while (slot.inFlight) {
+      complete();
+    }
+  }
+  checkError();
+  if (lseek(fd, static_cast<off_t>(nextOffset), SEEK_SET) == -1) {
+    throwErrno();
+  }
+}
+
+static bool isAligned (const iu8f *b, size_t alignment) noexcept {
+  return reinterpret_cast<uintptr_t>(b) % alignment == 0;
+}
+
+static int openDirect (const char *pathName, int flags) {
+  int fd;
+  do {
+    fd = open(pathName, flags | O_DIRECT | O_CLOEXEC, 0666);
+  } while (fd == -1 && errno == EINTR);
+  if (fd == -1) {
+    throwErrno();
+  }
+  return fd;
+}
+
+DirectFdInputStream::DirectFdInputStream (const char *pathName, size_t blockSize) : fd(-1), blockSize(blockSize), block(blockSize, blockSize) {
+  fd = openDirect(pathName, O_RDONLY);
+}
+
+DirectFdInputStream::DirectFdInputStream (const char *pathName) : DirectFdInputStream(pathName, 4096U) {
+}
+
+DirectFdInputStream::~DirectFdInputStream () {
+  close(fd);
+}
+
+int DirectFdInputStream::getFd () const noexcept {
+  return fd;
+}
+
+size_t DirectFdInputStream::read (iu8f *b, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+
+  if (block.exhausted()) {
+    if (size >= blockSize && isAligned(b, blockSize)) {
+      return FdInputStream(fd).read(b, size - size % blockSize);
+    }
+
+    size_t blockFill = FdInputStream(fd).read(get<0>(block.get()), blockSize);
+    if (blockFill == numeric_limits<size_t>::max()) {
+      return blockFill;
+    }
+    block.reset(blockFill);
+  }
+
+  auto v = block.getRemainder();
+  size = min(size, get<1>(v));
+  memcpy(b, get<0>(v), size);
+  block.advance(size);
+  return size;
+}
+
+DirectFdOutputStream::DirectFdOutputStream (const char *pathName, size_t blockSize) : fd(-1), blockSize(blockSize), block(blockSize, blockSize), writtenSize(0), finished(false) {
+  fd = openDirect(pathName, O_WRONLY | O_CREAT | O_TRUNC);
+  block.reset(blockSize);
+}
+
+DirectFdOutputStream::DirectFdOutputStream (const char *pathName) : DirectFdOutputStream(pathName, 4096U) {
+}
+
+DirectFdOutputStream::~DirectFdOutputStream () {
+  DPRE(finished || block.advancement() == 0, "finish() must have been called if any partial block is buffered");
+  close(fd);
+}
+
+int DirectFdOutputStream::getFd () const noexcept {
+  return fd;
+}
+
+void DirectFdOutputStream::write (const iu8f *b, size_t size) {
+  DPRE(!finished, "this must not have been finished");
+  while (size != 0) {
+    if (block.advancement() == 0 && size >= blockSize && isAligned(b, blockSize)) {
+      size_t directSize = size - size % blockSize;
+      FdOutputStream(fd).write(b, directSize);
+      writtenSize += directSize;
+      b += directSize;
+      size -= directSize;
+      continue;
+    }
+
+    auto v = block.getRemainder();
+    size_t copySize = min(size, get<1>(v));
+    memcpy(get<0>(v), b, copySize);
+    block.advance(copySize);
+    writtenSize += copySize;
+    b += copySize;
+    size -= copySize;
+    if (block.exhausted()) {
+      FdOutputStream(fd).write(get<0>(block.get()), blockSize);
+      block.reset(blockSize);
+    }
+  }
+}
+
+void DirectFdOutputStream::finish () {
+  DPRE(!finished, "this must not have been finished");
+  finished = true;
+  if (block.advancement() == 0) {
+    return;
+  }
+
+  auto v = block.getRemainder();
+  memset(get<0>(v), 0, get<1>(v));
+  FdOutputStream(fd).write(get<0>(block.get()), blockSize);
+  if (ftruncate(fd, static_cast<off_t>(writtenSize)) == -1) {
+    throwErrno();
+  }
+}
+
+const size_t wouldBlock = numeric_limits<size_t>::max() - 1;
+
+static void setNonBlocking (int fd) {
+  int flags = fcntl(fd, F_GETFL);
+  if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+    throwErrno();
+  }
+}
+
+AsyncFdInputStream::AsyncFdInputStream (int fd) : fd(fd) {
+  setNonBlocking(fd);
+}
+
+int AsyncFdInputStream::getFd () const noexcept {
+  return fd;
+}
+
+size_t AsyncFdInputStream::read (iu8f *b, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+
+  while (true) {
+    ssize_t r = ::read(fd, b, size);
+    if (r == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return wouldBlock;
+      }
+      throwErrno();
+    }
+    if (r == 0) {
+      return numeric_limits<size_t>::max();
+    }
+    return static_cast<size_t>(r);
+  }
+}
+
+AsyncFdOutputStream::AsyncFdOutputStream (int fd) : fd(fd) {
+  setNonBlocking(fd);
+}
+
+int AsyncFdOutputStream::getFd () const noexcept {
+  return fd;
+}
+
+size_t AsyncFdOutputStream::write (const iu8f *b, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+
+  while (true) {
+    ssize_t r = ::write(fd, b, size);
+    if (r == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return wouldBlock;
+      }
+      throwErrno();
+    }
+    return static_cast<size_t>(r);
+  }
+}
+
+AsyncTask AsyncTask::promise_type::get_return_object () noexcept {
+  return AsyncTask(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+std::suspend_always AsyncTask::promise_type::initial_suspend () const noexcept {
+  return std::suspend_always();
+}
+
+std::suspend_always AsyncTask::promise_type::final_suspend () const noexcept {
+  return std::suspend_always();
+}
+
+void AsyncTask::promise_type::return_void () const noexcept {
+}
+
+void AsyncTask::promise_type::unhandled_exception () noexcept {
+  exception = std::current_exception();
+}
+
+AsyncTask::AsyncTask (std::coroutine_handle<promise_type> handle) noexcept : handle(handle) {
+}
+
+AsyncTask::AsyncTask (AsyncTask &&o) noexcept : handle(o.handle) {
+  o.handle = nullptr;
+}
+
+AsyncTask::~AsyncTask () {
+  if (handle) {
+    handle.destroy();
+  }
+}
+
+AsyncWaiter::AsyncWaiter (EpollExecutor &r_executor, int fd, bool output) noexcept : executor(&r_executor), fd(fd), output(output) {
+}
+
+void AsyncWaiter::rethrowFailure () const {
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+bool AsyncWaiter::await_ready () {
+  return attempt();
+}
+
+void AsyncWaiter::await_suspend (std::coroutine_handle<> handle_) {
+  handle = handle_;
+  executor->wait(*this);
+}
+
+EpollExecutor::EpollExecutor () : waiterCount(0) {
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd == -1) {
+    throwErrno();
+  }
+}
+
+EpollExecutor::~EpollExecutor () {
+  for (void *task : tasks) {
+    std::coroutine_handle<>::from_address(task).destroy();
+  }
+  close(epollFd);
+}
+
+void EpollExecutor::spawn (AsyncTask &&task) {
+  DPRE(task.handle);
+  tasks.insert(task.handle.address());
+  runnables.push_back(task.handle);
+  task.handle = nullptr;
+}
+
+void EpollExecutor::wait (AsyncWaiter &r_waiter) {
+  FdWaiters waiters = {nullptr, nullptr};
+  auto i = fdWaiters.find(r_waiter.fd);
+  if (i != fdWaiters.end()) {
+    waiters = i->second;
+  }
+  AsyncWaiter *&r_slot = r_waiter.output ? waiters.output : waiters.input;
+  DPRE(!r_slot, "the file descriptor must not already be waited on in this direction");
+  r_slot = &r_waiter;
+
+  arm(r_waiter.fd, waiters);
+  fdWaiters[r_waiter.fd] = waiters;
+  ++waiterCount;
+}
+
+// Registers interest in whichever directions of fd have waiters (there being
+// one registration per file descriptor).
+void EpollExecutor::arm (int fd, const FdWaiters &waiters) {
+  epoll_event event;
+  event.events = (waiters.input ? EPOLLIN : 0U) | (waiters.output ? EPOLLOUT : 0U) | EPOLLONESHOT;
+  event.data.fd = fd;
+  if (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) == -1) {
+    if (errno != ENOENT || epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+      throwErrno();
+    }
+  }
+}
+
+// Retries the operation of r_waiter, clearing r_waiter (and scheduling its
+// coroutine) if the operation is no longer blocked.
+void EpollExecutor::resume (AsyncWaiter *&r_waiter) {
+  bool completed;
+  try {
+    completed = r_waiter->attempt();
+  } catch (...) {
+    r_waiter->exception = std::current_exception();
+    completed = true;
+  }
+  if (completed) {
+    runnables.push_back(r_waiter->handle);
+    r_waiter = nullptr;
+    --waiterCount;
+  }
+}
+
+void EpollExecutor::run () {
+  std::vector<std::coroutine_handle<>> resumables;
+  while (!tasks.empty()) {
+    while (!runnables.empty()) {
+      resumables.swap(runnables);
+      for (auto i = resumables.begin(), end = resumables.end(); i != end; ++i) {
+        std::coroutine_handle<> handle = *i;
+        handle.resume();
+        if (handle.done()) {
+          auto task = std::coroutine_handle<AsyncTask::promise_type>::from_address(handle.address());
+          std::exception_ptr exception = move(task.promise().exception);
+          tasks.erase(handle.address());
+          task.destroy();
+          if (exception) {
+            runnables.insert(runnables.end(), i + 1, end);
+            std::rethrow_exception(exception);
+          }
+        }
+      }
+      resumables.clear();
+    }
+    if (tasks.empty()) {
+      break;
+    }
+
+    DA(waiterCount != 0);
+    epoll_event events[64];
+    int eventCount = epoll_wait(epollFd, events, 64, -1);
+    if (eventCount == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throwErrno();
+    }
+    for (int eventI = 0; eventI != eventCount; ++eventI) {
+      int fd = events[eventI].data.fd;
+      auto readiness = events[eventI].events;
+      auto i = fdWaiters.find(fd);
+      DA(i != fdWaiters.end());
+      FdWaiters &waiters = i->second;
+      // An error or hang-up is reported to both directions, so that each can
+      // observe it from its operation.
+      if (waiters.input && (readiness & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0) {
+        resume(waiters.input);
+      }
+      if (waiters.output && (readiness & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0) {
+        resume(waiters.output);
+      }
+      if (waiters.input || waiters.output) {
+        arm(fd, waiters);
+      } else {
+        fdWaiters.erase(i);
+      }
+    }
+  }
+}
+
 /* -----------------------------------------------------------------------------
 ----------------------------------------------------------------------------- */
 }
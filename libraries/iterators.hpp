@@ -7,6 +7,12 @@
 #define ITERATORS_ALREADYINCLUDED
 
 #include <core.hpp>
+#include <coroutine>
+#include <exception>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace iterators {
 
@@ -16,12 +22,21 @@ extern DC();
 
 // TODO split into Window and BufferedWindow
 class BufferedWindow {
+  prv struct Deleter {
+    void operator() (iu8f *b) const noexcept;
+  };
+
   prv static iu8f *const endedMarker;
   prv iu8f *i;
   prv iu8f *end;
-  prv std::unique_ptr<iu8f []> b;
+  prv std::unique_ptr<iu8f [], Deleter> b;
   prv size_t capacity;
 
+  /**
+    @param alignment the alignment of the buffer, which must be a power of two
+    (e.g. {@c 64} for a cache line or {@c 4096} for a page).
+  */
+  pub BufferedWindow (size_t capacity, size_t alignment);
   pub explicit BufferedWindow (size_t capacity);
   pub BufferedWindow () noexcept;
   BufferedWindow (const BufferedWindow &) = delete;
@@ -38,8 +53,11 @@ class BufferedWindow {
   pub iu8f &operator* () noexcept;
   pub void operator++ () noexcept;
   pub iu8f *operator++ (int) noexcept;
-  // TODO ptr access to the remainder of the buffer (+ ability to 'consume/fill in' part/all thereof)
-  // TODO wrapper to read x bytes (view on the buffer if possible, by copying to a new block if necessary)
+  pub std::tuple<iu8f *, size_t> getRemainder () noexcept;
+  pub void advance (size_t size) noexcept;
+  pub void compact () noexcept;
+  pub std::tuple<iu8f *, size_t> getSpare () noexcept;
+  pub void extend (size_t size) noexcept;
 };
 
 /**
@@ -59,6 +77,8 @@ class BufferedWindow {
 */
 
 template<typename _Stream> class InputStreamEndIterator;
+template<typename _Stream> class OutputStreamIterator;
+template<typename _Stream> class FrameReader;
 
 /**
   Wraps an {@c InputStream} in an InputIterator.
@@ -73,10 +93,13 @@ template<typename _Stream> class InputStreamEndIterator;
 // TODO SimpleInputStreamIterator (move-only, no post inc, expected that inc can cause blocking)
 template<typename _Stream> class InputStreamIterator : public std::iterator<std::input_iterator_tag, iu8f, std::ptrdiff_t, iu8f *, iu8f> {
   friend class InputStreamEndIterator<_Stream>;
+  friend class FrameReader<_Stream>;
+  template<typename _InputStream, typename _OutputStream> friend size_t pump (InputStreamIterator<_InputStream> &r_in, OutputStreamIterator<_OutputStream> &r_out, size_t size);
 
   prv BufferedWindow window;
   prv _Stream *stream;
 
+  pub InputStreamIterator (_Stream &r_stream, size_t bufferCapacity, size_t bufferAlignment);
   pub InputStreamIterator (_Stream &r_stream, size_t bufferCapacity);
   pub explicit InputStreamIterator (_Stream &r_stream);
   pub InputStreamIterator () noexcept;
@@ -122,10 +145,13 @@ template<typename _Stream> class InputStreamEndIterator : public InputStreamIter
 */
 // TODO split into OutputStreamBufferWindow and OutputWindowIterator
 template<typename _Stream> class OutputStreamIterator : public std::iterator<std::output_iterator_tag, iu8f, std::ptrdiff_t> {
+  template<typename _InputStream, typename _OutputStream> friend size_t pump (InputStreamIterator<_InputStream> &r_in, OutputStreamIterator<_OutputStream> &r_out, size_t size);
+
   prv BufferedWindow window;
   prv _Stream *stream;
   DI(prv is8f indirectionsMinusIncrements;)
 
+  pub OutputStreamIterator (_Stream &r_stream, size_t bufferCapacity, size_t bufferAlignment);
   pub OutputStreamIterator (_Stream &r_stream, size_t bufferCapacity);
   pub explicit OutputStreamIterator (_Stream &r_stream);
   // TODO flush on destruction?
@@ -141,6 +167,606 @@ template<typename _Stream> class OutputStreamIterator : public std::iterator<std
   pub OutputStreamIterator<_Stream> &operator++ (int);
 };
 
+/**
+  Reads runs of octets (frames) of exact lengths from an InputStreamIterator.
+
+  A frame that is already in the iterator's window is returned as a view onto
+  the window. A frame that straddles the end of the buffered octets is
+  gathered by moving the octets to the start of the window and then refilling
+  it, unless the frame is larger than the window, in which case it is read into a
+  separate block owned by the instance. In either case, the returned octets are
+  valid only until the next operation on the instance or the iterator.
+*/
+template<typename _Stream> class FrameReader {
+  prv InputStreamIterator<_Stream> *i;
+  prv size_t maxSize;
+  prv std::unique_ptr<iu8f []> block;
+  prv size_t blockCapacity;
+
+  /**
+    @param maxSize the greatest length of frame that readLengthPrefixed() will
+    accept.
+  */
+  pub FrameReader (InputStreamIterator<_Stream> &r_i, size_t maxSize);
+
+  /**
+    Reads a frame of {@p size} octets.
+
+    @return the frame or, if the end of the stream is reached before {@p size}
+    octets have been read, {@c nullptr} and the number of octets that were
+    read.
+  */
+  pub std::tuple<const iu8f *, size_t> read (size_t size);
+  /**
+    Reads a frame that is preceded by its length, as a big-endian unsigned integer
+    of {@p prefixSize} octets.
+
+    @return the frame (not including the length) or, if the end of the stream is
+    reached before the whole of the length and frame have been read,
+    {@c nullptr} and the number of octets of the length or frame (whichever was
+    truncated) that were read.
+    @throws std::length_error if the length is greater than {@c maxSize} (in
+    which case only the length has been consumed).
+  */
+  pub std::tuple<const iu8f *, size_t> readLengthPrefixed (size_t prefixSize);
+};
+
+/**
+  An {@c InputStream} that reads from a file descriptor (which is not owned by
+  the instance).
+*/
+class FdInputStream {
+  prv int fd;
+
+  pub explicit FdInputStream (int fd) noexcept;
+
+  pub int getFd () const noexcept;
+  pub size_t read (iu8f *b, size_t size);
+};
+
+/**
+  An {@c OutputStream} that writes to a file descriptor (which is not owned by
+  the instance).
+*/
+class FdOutputStream {
+  prv int fd;
+
+  pub explicit FdOutputStream (int fd) noexcept;
+
+  pub int getFd () const noexcept;
+  pub void write (const iu8f *b, size_t size);
+};
+
+/**
+  Moves at most {@p size} octets from {@p r_in} to {@p r_out}. Any octets already
+  buffered by {@p r_in} are taken first; {@p r_out} is flushed and the rest are
+  then moved directly between the underlying streams via transfer().
+
+  @return the number of octets moved, which is less than {@p size} only if the
+  end of the input has been reached.
+*/
+template<typename _InputStream, typename _OutputStream> size_t pump (InputStreamIterator<_InputStream> &r_in, OutputStreamIterator<_OutputStream> &r_out, size_t size);
+
+/**
+  Moves at most {@p size} octets from {@p r_in} to {@p r_out} by copying them in
+  large blocks.
+
+  @return the number of octets moved, which is less than {@p size} only if the
+  end of the input has been reached.
+*/
+template<typename _InputStream, typename _OutputStream> size_t transfer (_InputStream &r_in, _OutputStream &r_out, size_t size);
+
+/**
+  Moves at most {@p size} octets from {@p r_in} to {@p r_out} within the kernel
+  (via {@c splice()}, {@c copy_file_range()} or {@c sendfile()}, as the types of
+  the file descriptors allow), falling back to copying them in large blocks.
+
+  @return the number of octets moved, which is less than {@p size} only if the
+  end of the input has been reached.
+*/
+size_t transfer (FdInputStream &r_in, FdOutputStream &r_out, size_t size);
+
+/**
+  An {@c InputStream} that reads from a file opened with {@c O_DIRECT}, bypassing
+  the page cache.
+
+  Reads from the file are made in whole blocks of {@c blockSize} octets into
+  buffers aligned to {@c blockSize}; when {@c read()} is called with a buffer
+  that is aligned and at least a block in size (e.g. that of an
+  InputStreamIterator constructed with a {@c bufferAlignment} of
+  {@c blockSize}), the octets are read into it directly.
+*/
+class DirectFdInputStream {
+  prv int fd;
+  prv size_t blockSize;
+  prv BufferedWindow block;
+
+  pub DirectFdInputStream (const char *pathName, size_t blockSize);
+  pub explicit DirectFdInputStream (const char *pathName);
+  DirectFdInputStream (const DirectFdInputStream &) = delete;
+  DirectFdInputStream &operator= (const DirectFdInputStream &) = delete;
+  pub ~DirectFdInputStream ();
+
+  pub int getFd () const noexcept;
+  pub size_t read (iu8f *b, size_t size);
+};
+
+/**
+  An {@c OutputStream} that writes to a file (created or truncated) opened with
+  {@c O_DIRECT}, bypassing the page cache.
+
+  Writes to the file are made in whole blocks of {@c blockSize} octets from
+  buffers aligned to {@c blockSize}; when {@c write()} is called with a buffer
+  that is aligned and at least a block in size (e.g. that of an
+  OutputStreamIterator constructed with a {@c bufferAlignment} of
+  {@c blockSize}), the octets are written from it directly. Octets that don't
+  make up a whole block are buffered; finish() must be called once everything
+  has been written.
+*/
+class DirectFdOutputStream {
+  prv int fd;
+  prv size_t blockSize;
+  prv BufferedWindow block;
+  prv iu64f writtenSize;
+  prv bool finished;
+
+  pub DirectFdOutputStream (const char *pathName, size_t blockSize);
+  pub explicit DirectFdOutputStream (const char *pathName);
+  DirectFdOutputStream (const DirectFdOutputStream &) = delete;
+  DirectFdOutputStream &operator= (const DirectFdOutputStream &) = delete;
+  pub ~DirectFdOutputStream ();
+
+  pub int getFd () const noexcept;
+  pub void write (const iu8f *b, size_t size);
+  /**
+    Writes out any final partial block (padded to a whole block, with the file
+    then being truncated to the number of octets written). No further octets may
+    be written.
+  */
+  pub void finish ();
+};
+
+/**
+  @interface SeekableInputStream
+
+  Reads octets from a sequence of known size, at arbitrary positions.
+
+
+  @fn size_t readAt (iu8f *b, size_t size, iu64f offset)
+
+  Copies at most {@p size} octets from the stream, starting at {@p offset}, into
+  {@p b}.
+
+  @return the number of octets copied, which is less than {@p size} only if the
+  end of the stream was reached.
+
+
+  @fn iu64f getSize () const
+
+  @return the number of octets in the stream.
+*/
+
+/**
+  A {@c SeekableInputStream} that reads from a file descriptor (which is not
+  owned by the instance) via {@c pread()}.
+*/
+class FdSeekableInputStream {
+  prv int fd;
+  prv iu64f totalSize;
+
+  pub explicit FdSeekableInputStream (int fd);
+
+  pub int getFd () const noexcept;
+  pub size_t readAt (iu8f *b, size_t size, iu64f offset);
+  pub iu64f getSize () const noexcept;
+};
+
+/**
+  Caches up to {@c blockCapacity} blocks of {@c blockSize} octets from a
+  {@c SeekableInputStream}, evicting the least recently used.
+
+  When a block that is not cached is requested straight after the blocks last
+  read from the stream, the access is taken to be sequential, and (up to
+  {@c maxReadAheadCount}) following blocks are read from the stream along with
+  it; the number of blocks read ahead doubles with each further sequential miss.
+  Such runs of blocks are read with a single call into a separate buffer of
+  {@c (maxReadAheadCount + 1) * blockSize} octets, so the memory used is up to
+  {@c (blockCapacity + maxReadAheadCount + 1) * blockSize} octets.
+*/
+template<typename _Stream> class BlockCache {
+  prv struct Block {
+    iu64f blockI;
+    std::unique_ptr<iu8f []> b;
+    size_t size;
+  };
+
+  prv _Stream *stream;
+  prv size_t blockSize;
+  prv size_t blockCapacity;
+  prv size_t maxReadAheadCount;
+  prv std::list<Block> blocks;
+  prv std::unordered_map<iu64f, typename std::list<Block>::iterator> blockIs;
+  prv iu64f nextSequentialBlockI;
+  prv size_t readAheadCount;
+  prv std::unique_ptr<iu8f []> run;
+
+  pub BlockCache (_Stream &r_stream, size_t blockSize, size_t blockCapacity, size_t maxReadAheadCount);
+  pub BlockCache (_Stream &r_stream, size_t blockSize, size_t blockCapacity);
+
+  pub iu64f getSize () const;
+  /**
+    @return the octets from {@p position} to the end of the block containing
+    it, which remain valid until the next call.
+  */
+  pub std::tuple<const iu8f *, size_t> get (iu64f position);
+  prv void load (iu64f blockI, size_t count);
+  prv void discard (size_t count) noexcept;
+};
+
+/**
+  A random-access iterator over the octets of a {@c SeekableInputStream}, read
+  via a BlockCache.
+*/
+// DODGY since indirection returns a value (not a ref), should only be an InputIterator
+template<typename _Stream> class SeekableStreamIterator : public std::iterator<std::random_access_iterator_tag, iu8f, std::ptrdiff_t, const iu8f *, iu8f> {
+  prv typedef std::ptrdiff_t Distance;
+  prv BlockCache<_Stream> *cache;
+  prv iu64f position;
+
+  pub SeekableStreamIterator (BlockCache<_Stream> &r_cache, iu64f position) noexcept;
+  pub SeekableStreamIterator () noexcept;
+
+  pub bool operator== (const SeekableStreamIterator<_Stream> &r) const noexcept;
+  pub bool operator!= (const SeekableStreamIterator<_Stream> &r) const noexcept;
+  pub bool operator< (const SeekableStreamIterator<_Stream> &r) const noexcept;
+  pub iu8f operator* () const;
+  pub SeekableStreamIterator<_Stream> &operator++ () noexcept;
+  pub SeekableStreamIterator<_Stream> operator++ (int) noexcept;
+  pub SeekableStreamIterator<_Stream> &operator-- () noexcept;
+  pub SeekableStreamIterator<_Stream> operator-- (int) noexcept;
+  pub SeekableStreamIterator<_Stream> &operator+= (const Distance &r) noexcept;
+  friend SeekableStreamIterator<_Stream> operator+ (SeekableStreamIterator<_Stream> l, const Distance &r) noexcept {
+    return l += r;
+  }
+  friend SeekableStreamIterator<_Stream> operator+ (const Distance &l, SeekableStreamIterator<_Stream> r) noexcept {
+    return r += l;
+  }
+  pub SeekableStreamIterator<_Stream> &operator-= (const Distance &r) noexcept;
+  friend SeekableStreamIterator<_Stream> operator- (SeekableStreamIterator<_Stream> l, const Distance &r) noexcept {
+    return l -= r;
+  }
+  friend Distance operator- (const SeekableStreamIterator<_Stream> &l, const SeekableStreamIterator<_Stream> &r) noexcept {
+    return static_cast<Distance>(l.position - r.position);
+  }
+  pub iu8f operator[] (const Distance &r) const;
+};
+
+class IoUring;
+
+/**
+  A buffer used by a UringInputStream or UringOutputStream, along with the state
+  of the operation on it.
+*/
+struct UringSlot {
+  BufferedWindow window;
+  iu64f offset;
+  size_t size;
+  size_t done;
+  int error;
+  bool inFlight;
+  bool ended;
+};
+
+/**
+  An {@c InputStream} that reads from a file descriptor (which is not owned by
+  the instance) via io_uring, keeping up to {@c depth} reads of
+  {@c bufferCapacity} octets in flight ahead of the consumer.
+
+  Reads are made from the file position at construction onwards; when the
+  instance is destroyed, the file position is moved to just after the last octet
+  consumed. If io_uring is unavailable or the file descriptor is not seekable,
+  reads are made directly (as by FdInputStream).
+*/
+class UringInputStream {
+  prv int fd;
+  prv std::unique_ptr<IoUring> ring;
+  prv std::vector<UringSlot> slots;
+  prv size_t headSlotI;
+  prv iu64f nextOffset;
+  prv iu64f position;
+
+  pub UringInputStream (int fd, size_t depth, size_t bufferCapacity);
+  UringInputStream (const UringInputStream &) = delete;
+  UringInputStream &operator= (const UringInputStream &) = delete;
+  pub ~UringInputStream ();
+
+  prv void submit (size_t slotI);
+  prv void issue (size_t slotI);
+  prv void complete ();
+  pub size_t read (iu8f *b, size_t size);
+};
+
+/**
+  An {@c OutputStream} that writes to a file descriptor (which is not owned by
+  the instance) via io_uring, keeping up to {@c depth} writes of
+  {@c bufferCapacity} octets in flight behind the producer.
+
+  Writes are made from the file position at construction onwards. Octets written
+  to an instance may be buffered; flush() should be called whenever it is
+  necessary that everything written so far should have been written to the file
+  descriptor (and before the instance is destroyed). If io_uring is unavailable
+  or the file descriptor is not seekable, writes are made directly (as by
+  FdOutputStream).
+
+  Once a write has failed, the instance is unusable: every subsequent call to
+  write() or flush() throws the same error, so that nothing is written beyond the
+  gap that the failed write left.
+*/
+class UringOutputStream {
+  prv int fd;
+  prv std::unique_ptr<IoUring> ring;
+  prv std::vector<UringSlot> slots;
+  prv size_t tailSlotI;
+  prv iu64f nextOffset;
+  prv int error;
+
+  pub UringOutputStream (int fd, size_t depth, size_t bufferCapacity);
+  UringOutputStream (const UringOutputStream &) = delete;
+  UringOutputStream &operator= (const UringOutputStream &) = delete;
+  pub ~UringOutputStream ();
+
+  prv void submit (size_t slotI);
+  prv void issue (size_t slotI);
+  prv void complete ();
+  prv void checkError () const;
+  pub void write (const iu8f *b, size_t size);
+  /**
+    Ensures that all octets written have been written to the file descriptor, and
+    moves the file position to just after them.
+  */
+  pub void flush ();
+};
+
+/**
+  The value returned by {@c AsyncInputStream::read()} and
+  {@c AsyncOutputStream::write()} when the operation would block.
+*/
+extern const size_t wouldBlock;
+
+/**
+  @interface AsyncInputStream
+
+  Reads octets from a sequence of unbounded size, without blocking.
+
+
+  @fn size_t read (iu8f *b, size_t size)
+
+  Moves at most {@p size} octets from the head of the stream into {@p b}.
+
+  @return {@c numeric_limits<size_t>::max()}, if the stream is empty (in which
+  case no octets were moved), {@c wouldBlock}, if no octets are available yet (in
+  which case no octets were moved), or the number of octets moved, which is at
+  least {@c 1} (unless {@c size == 0}) and no greater than {@p size}.
+
+
+  @fn int getFd () const
+
+  @return the file descriptor that becomes readable when octets are available.
+*/
+
+/**
+  @interface AsyncOutputStream
+
+  Writes octets to form a sequence of unbounded size, without blocking.
+
+
+  @fn size_t write (const iu8f *b, size_t size)
+
+  Copies at most {@p size} octets from {@p b} to the tail of the stream.
+
+  @return {@c wouldBlock}, if the stream can't accept any octets yet (in which
+  case no octets were copied), or the number of octets copied, which is at least
+  {@c 1} (unless {@c size == 0}) and no greater than {@p size}.
+
+
+  @fn int getFd () const
+
+  @return the file descriptor that becomes writable when octets can be accepted.
+*/
+
+/**
+  An {@c AsyncInputStream} that reads from a file descriptor (which is not owned
+  by the instance, and which is put into non-blocking mode), such as a pipe or
+  socket.
+*/
+class AsyncFdInputStream {
+  prv int fd;
+
+  pub explicit AsyncFdInputStream (int fd);
+
+  pub int getFd () const noexcept;
+  pub size_t read (iu8f *b, size_t size);
+};
+
+/**
+  An {@c AsyncOutputStream} that writes to a file descriptor (which is not owned
+  by the instance, and which is put into non-blocking mode), such as a pipe or
+  socket.
+*/
+class AsyncFdOutputStream {
+  prv int fd;
+
+  pub explicit AsyncFdOutputStream (int fd);
+
+  pub int getFd () const noexcept;
+  pub size_t write (const iu8f *b, size_t size);
+};
+
+class EpollExecutor;
+
+/**
+  The return type of coroutines that are run by an EpollExecutor.
+*/
+class AsyncTask {
+  friend class EpollExecutor;
+
+  pub struct promise_type {
+    std::exception_ptr exception;
+
+    AsyncTask get_return_object () noexcept;
+    std::suspend_always initial_suspend () const noexcept;
+    std::suspend_always final_suspend () const noexcept;
+    void return_void () const noexcept;
+    void unhandled_exception () noexcept;
+  };
+
+  prv std::coroutine_handle<promise_type> handle;
+
+  prv explicit AsyncTask (std::coroutine_handle<promise_type> handle) noexcept;
+  pub AsyncTask (AsyncTask &&o) noexcept;
+  AsyncTask (const AsyncTask &) = delete;
+  AsyncTask &operator= (const AsyncTask &) = delete;
+  pub ~AsyncTask ();
+};
+
+/**
+  An awaitable operation on a file descriptor, which (if it can't be completed
+  immediately) suspends the awaiting coroutine until the operation can be
+  completed. The operation is retried each time that the file descriptor
+  becomes ready.
+*/
+class AsyncWaiter {
+  friend class EpollExecutor;
+
+  prv EpollExecutor *executor;
+  prv int fd;
+  prv bool output;
+  prv std::coroutine_handle<> handle;
+  prv std::exception_ptr exception;
+
+  prt AsyncWaiter (EpollExecutor &r_executor, int fd, bool output) noexcept;
+  prt ~AsyncWaiter () = default;
+
+  /**
+    Tries to complete the operation.
+
+    @return {@c false} iff the operation would block.
+  */
+  prt virtual bool attempt () = 0;
+  prt void rethrowFailure () const;
+  pub bool await_ready ();
+  pub void await_suspend (std::coroutine_handle<> handle);
+};
+
+/**
+  Runs coroutines on the current thread, resuming each when the operation that
+  it's awaiting (an AsyncWaiter) can be completed. Each file descriptor may be
+  waited on by at most one reading coroutine and one writing coroutine at a time
+  (so that, for example, a socket can be read from and written to concurrently).
+*/
+class EpollExecutor {
+  friend class AsyncWaiter;
+
+  prv struct FdWaiters {
+    AsyncWaiter *input;
+    AsyncWaiter *output;
+  };
+
+  prv int epollFd;
+  prv std::vector<std::coroutine_handle<>> runnables;
+  prv std::unordered_set<void *> tasks;
+  prv std::unordered_map<int, FdWaiters> fdWaiters;
+  prv size_t waiterCount;
+
+  pub EpollExecutor ();
+  EpollExecutor (const EpollExecutor &) = delete;
+  EpollExecutor &operator= (const EpollExecutor &) = delete;
+  pub ~EpollExecutor ();
+
+  /**
+    Takes ownership of the coroutine {@p task}, which will be started by run().
+  */
+  pub void spawn (AsyncTask &&task);
+  prv void wait (AsyncWaiter &r_waiter);
+  prv void arm (int fd, const FdWaiters &waiters);
+  prv void resume (AsyncWaiter *&r_waiter);
+  /**
+    Runs the spawned coroutines until they have all completed. If a coroutine
+    exits via an exception, the exception is rethrown from here.
+  */
+  pub void run ();
+};
+
+/**
+  Wraps an {@c AsyncInputStream} so that it can be iterated over by a coroutine
+  run by an EpollExecutor.
+
+  Before each element is read, {@c co_await ensureBuffer()} must be evaluated,
+  which suspends the coroutine (if necessary) until the window holds an octet or
+  the end of the stream has been reached.
+*/
+template<typename _Stream> class AsyncInputStreamIterator {
+  prv class Filler : public AsyncWaiter {
+    prv AsyncInputStreamIterator<_Stream> *i;
+
+    pub explicit Filler (AsyncInputStreamIterator<_Stream> &r_i) noexcept;
+
+    prt bool attempt () override;
+    /**
+      @return {@c false} iff the end of the stream has been reached.
+    */
+    pub bool await_resume () const;
+  };
+
+  prv BufferedWindow window;
+  prv _Stream *stream;
+  prv EpollExecutor *executor;
+
+  pub AsyncInputStreamIterator (EpollExecutor &r_executor, _Stream &r_stream, size_t bufferCapacity);
+  pub AsyncInputStreamIterator (EpollExecutor &r_executor, _Stream &r_stream);
+
+  prv bool tryEnsureBuffer ();
+  pub Filler ensureBuffer ();
+  pub iu8f operator* () noexcept;
+  pub AsyncInputStreamIterator<_Stream> &operator++ () noexcept;
+};
+
+/**
+  Wraps an {@c AsyncOutputStream} so that it can be written to by a coroutine
+  run by an EpollExecutor.
+
+  Before each element is written, {@c co_await ensureBuffer()} must be
+  evaluated, which suspends the coroutine (if necessary) until the window has
+  room for an octet. {@c co_await flushToStream()} should be evaluated whenever
+  it is necessary that everything written so far should have been passed to the
+  underlying {@c AsyncOutputStream}.
+*/
+template<typename _Stream> class AsyncOutputStreamIterator {
+  prv class Flusher : public AsyncWaiter {
+    prv AsyncOutputStreamIterator<_Stream> *i;
+    prv bool whenFull;
+
+    pub Flusher (AsyncOutputStreamIterator<_Stream> &r_i, bool whenFull) noexcept;
+
+    prt bool attempt () override;
+    pub void await_resume () const;
+  };
+
+  prv BufferedWindow window;
+  prv _Stream *stream;
+  prv EpollExecutor *executor;
+  prv size_t flushedSize;
+
+  pub AsyncOutputStreamIterator (EpollExecutor &r_executor, _Stream &r_stream, size_t bufferCapacity);
+  pub AsyncOutputStreamIterator (EpollExecutor &r_executor, _Stream &r_stream);
+
+  prv bool tryFlushToStream ();
+  pub Flusher ensureBuffer ();
+  pub Flusher flushToStream ();
+  pub iu8f &operator* () noexcept;
+  pub AsyncOutputStreamIterator<_Stream> &operator++ () noexcept;
+};
+
 /**
   Wraps an iterator so that each element is a subobject of the underlying element
   or (if this is exactly an InputIterator) a value derived from the underlying
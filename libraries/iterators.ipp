@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 #include <tuple>
 
 namespace iterators {
@@ -7,9 +10,13 @@ using core::numeric_limits;
 using std::move;
 using std::tuple;
 using core::offset;
+using std::min;
 
 /* -----------------------------------------------------------------------------
 ----------------------------------------------------------------------------- */
+template<typename _Stream> InputStreamIterator<_Stream>::InputStreamIterator (_Stream &r_stream, size_t bufferCapacity, size_t bufferAlignment) : window(bufferCapacity, bufferAlignment), stream(&r_stream) {
+}
+
 template<typename _Stream> InputStreamIterator<_Stream>::InputStreamIterator (_Stream &r_stream, size_t bufferCapacity) : window(bufferCapacity), stream(&r_stream) {
 }
 
@@ -101,6 +108,10 @@ template<typename _Stream> bool InputStreamEndIterator<_Stream>::operator!= (Inp
   return r_r != *this;
 }
 
+template<typename _Stream> OutputStreamIterator<_Stream>::OutputStreamIterator (_Stream &r_stream, size_t bufferCapacity, size_t bufferAlignment) : window(bufferCapacity, bufferAlignment), stream(&r_stream) {
+  DI(indirectionsMinusIncrements = 0;)
+}
+
 template<typename _Stream> OutputStreamIterator<_Stream>::OutputStreamIterator (_Stream &r_stream, size_t bufferCapacity) : window(bufferCapacity), stream(&r_stream) {
   DI(indirectionsMinusIncrements = 0;)
 }
@@ -144,6 +155,383 @@ template<typename _Stream> OutputStreamIterator<_Stream> &OutputStreamIterator<_
   return ++*this;
 }
 
+template<typename _Stream> FrameReader<_Stream>::FrameReader (InputStreamIterator<_Stream> &r_i, size_t maxSize) : i(&r_i), maxSize(maxSize), block(), blockCapacity(0) {
+}
+
+template<typename _Stream> tuple<const iu8f *, size_t> FrameReader<_Stream>::read (size_t size) {
+  BufferedWindow &window = i->window;
+  if (window.ended()) {
+    return tuple<const iu8f *, size_t>(nullptr, 0);
+  }
+
+  auto v = window.getRemainder();
+  iu8f *b = get<0>(v);
+  size_t bufferedSize = get<1>(v);
+  if (bufferedSize >= size) {
+    window.advance(size);
+    return tuple<const iu8f *, size_t>(b, size);
+  }
+
+  DPRE(i->stream);
+  if (size <= get<1>(window.get())) {
+    window.compact();
+    while (bufferedSize < size) {
+      auto spare = window.getSpare();
+      size_t fillSize = i->stream->read(get<0>(spare), get<1>(spare));
+      DA(fillSize != 0);
+      if (fillSize == numeric_limits<size_t>::max()) {
+        window.unset();
+        return tuple<const iu8f *, size_t>(nullptr, bufferedSize);
+      }
+      window.extend(fillSize);
+      bufferedSize += fillSize;
+    }
+    b = get<0>(window.getRemainder());
+    window.advance(size);
+    return tuple<const iu8f *, size_t>(b, size);
+  }
+
+  if (size > blockCapacity) {
+    block.reset(new iu8f[size]);
+    blockCapacity = size;
+  }
+  memcpy(block.get(), b, bufferedSize);
+  window.advance(bufferedSize);
+  while (bufferedSize != size) {
+    size_t fillSize = i->stream->read(block.get() + bufferedSize, size - bufferedSize);
+    DA(fillSize != 0);
+    if (fillSize == numeric_limits<size_t>::max()) {
+      window.unset();
+      return tuple<const iu8f *, size_t>(nullptr, bufferedSize);
+    }
+    bufferedSize += fillSize;
+  }
+  return tuple<const iu8f *, size_t>(block.get(), size);
+}
+
+template<typename _Stream> tuple<const iu8f *, size_t> FrameReader<_Stream>::readLengthPrefixed (size_t prefixSize) {
+  DPRE(prefixSize != 0 && prefixSize <= sizeof(size_t));
+  auto v = read(prefixSize);
+  const iu8f *b = get<0>(v);
+  if (!b) {
+    return v;
+  }
+
+  size_t size = 0;
+  for (size_t j = 0; j != prefixSize; ++j) {
+    size = (size << 8) | b[j];
+  }
+  if (size > maxSize) {
+    throw std::length_error("frame length exceeds the maximum");
+  }
+  return read(size);
+}
+
+template<typename _Stream> BlockCache<_Stream>::BlockCache (_Stream &r_stream, size_t blockSize, size_t blockCapacity, size_t maxReadAheadCount) : stream(&r_stream), blockSize(blockSize), blockCapacity(blockCapacity), maxReadAheadCount(min(maxReadAheadCount, blockCapacity - 1)), nextSequentialBlockI(0), readAheadCount(0) {
+  DPRE(blockSize != 0);
+  DPRE(blockCapacity != 0);
+  if (this->maxReadAheadCount != 0) {
+    run.reset(new iu8f[blockSize * (this->maxReadAheadCount + 1)]);
+  }
+}
+
+template<typename _Stream> BlockCache<_Stream>::BlockCache (_Stream &r_stream, size_t blockSize, size_t blockCapacity) : BlockCache(r_stream, blockSize, blockCapacity, 32U) {
+}
+
+template<typename _Stream> iu64f BlockCache<_Stream>::getSize () const {
+  return stream->getSize();
+}
+
+template<typename _Stream> tuple<const iu8f *, size_t> BlockCache<_Stream>::get (iu64f position) {
+  DPRE(position < stream->getSize(), "position must be within the stream");
+  iu64f blockI = position / blockSize;
+  size_t blockOffset = static_cast<size_t>(position % blockSize);
+
+  if (blocks.empty() || blocks.front().blockI != blockI) {
+    auto m = blockIs.find(blockI);
+    if (m != blockIs.end()) {
+      blocks.splice(blocks.begin(), blocks, m->second);
+    } else {
+      if (blockI == nextSequentialBlockI) {
+        readAheadCount = min(readAheadCount == 0 ? 1 : readAheadCount * 2, maxReadAheadCount);
+      } else {
+        readAheadCount = 0;
+      }
+
+      iu64f endBlockI = (stream->getSize() + blockSize - 1) / blockSize;
+      size_t count = 1;
+      while (count <= readAheadCount && blockI + count != endBlockI && blockIs.find(blockI + count) == blockIs.end()) {
+        ++count;
+      }
+      load(blockI, count);
+      nextSequentialBlockI = blockI + count;
+    }
+  }
+
+  Block &block = blocks.front();
+  DA(block.blockI == blockI);
+  return tuple<const iu8f *, size_t>(block.b.get() + blockOffset, block.size - blockOffset);
+}
+
+template<typename _Stream> void BlockCache<_Stream>::load (iu64f blockI, size_t count) {
+  DA(count != 0 && count <= blockCapacity);
+  iu64f offset = blockI * blockSize;
+  size_t size = static_cast<size_t>(min(static_cast<iu64f>(blockSize * count), stream->getSize() - offset));
+
+  // The blocks are gathered (allocating any new ones before evicting any old
+  // ones) and filled off to the side, so that a failure leaves the cache
+  // consistent.
+  std::list<Block> loaded;
+  while (loaded.size() != count && blocks.size() + loaded.size() != blockCapacity) {
+    loaded.push_back(Block{0, std::unique_ptr<iu8f []>(new iu8f[blockSize]), 0});
+  }
+  while (loaded.size() != count) {
+    blockIs.erase(blocks.back().blockI);
+    loaded.splice(loaded.end(), blocks, std::prev(blocks.end()));
+  }
+
+  iu8f *b = count == 1 ? loaded.front().b.get() : run.get();
+  if (stream->readAt(b, size, offset) != size) {
+    throw std::runtime_error("stream is shorter than its stated size");
+  }
+  size_t j = 0;
+  for (Block &block : loaded) {
+    block.blockI = blockI + j;
+    block.size = min(blockSize, size - min(size, j * blockSize));
+    if (count != 1) {
+      memcpy(block.b.get(), b + j * blockSize, block.size);
+    }
+    ++j;
+  }
+
+  blocks.splice(blocks.begin(), loaded);
+  try {
+    auto i = blocks.begin();
+    for (j = 0; j != count; ++j, ++i) {
+      blockIs[i->blockI] = i;
+    }
+  } catch (...) {
+    discard(count);
+    throw;
+  }
+}
+
+template<typename _Stream> void BlockCache<_Stream>::discard (size_t count) noexcept {
+  for (size_t j = 0; j != count; ++j) {
+    blockIs.erase(blocks.front().blockI);
+    blocks.pop_front();
+  }
+}
+
+template<typename _Stream> SeekableStreamIterator<_Stream>::SeekableStreamIterator (BlockCache<_Stream> &r_cache, iu64f position) noexcept : cache(&r_cache), position(position) {
+}
+
+template<typename _Stream> SeekableStreamIterator<_Stream>::SeekableStreamIterator () noexcept : cache(nullptr), position(0) {
+}
+
+template<typename _Stream> bool SeekableStreamIterator<_Stream>::operator== (const SeekableStreamIterator<_Stream> &r) const noexcept {
+  return position == r.position;
+}
+
+template<typename _Stream> bool SeekableStreamIterator<_Stream>::operator!= (const SeekableStreamIterator<_Stream> &r) const noexcept {
+  return !(*this == r);
+}
+
+template<typename _Stream> bool SeekableStreamIterator<_Stream>::operator< (const SeekableStreamIterator<_Stream> &r) const noexcept {
+  return position < r.position;
+}
+
+template<typename _Stream> iu8f SeekableStreamIterator<_Stream>::operator* () const {
+  DPRE(cache);
+  return *get<0>(cache->get(position));
+}
+
+template<typename _Stream> SeekableStreamIterator<_Stream> &SeekableStreamIterator<_Stream>::operator++ () noexcept {
+  ++position;
+  return *this;
+}
+
+template<typename _Stream> SeekableStreamIterator<_Stream> SeekableStreamIterator<_Stream>::operator++ (int) noexcept {
+  SeekableStreamIterator<_Stream> o(*this);
+  ++position;
+  return o;
+}
+
+template<typename _Stream> SeekableStreamIterator<_Stream> &SeekableStreamIterator<_Stream>::operator-- () noexcept {
+  --position;
+  return *this;
+}
+
+template<typename _Stream> SeekableStreamIterator<_Stream> SeekableStreamIterator<_Stream>::operator-- (int) noexcept {
+  SeekableStreamIterator<_Stream> o(*this);
+  --position;
+  return o;
+}
+
+template<typename _Stream> SeekableStreamIterator<_Stream> &SeekableStreamIterator<_Stream>::operator+= (const Distance &r) noexcept {
+  position += static_cast<iu64f>(r);
+  return *this;
+}
+
+template<typename _Stream> SeekableStreamIterator<_Stream> &SeekableStreamIterator<_Stream>::operator-= (const Distance &r) noexcept {
+  position -= static_cast<iu64f>(r);
+  return *this;
+}
+
+template<typename _Stream> iu8f SeekableStreamIterator<_Stream>::operator[] (const Distance &r) const {
+  return *(*this + r);
+}
+
+template<typename _InputStream, typename _OutputStream> size_t pump (InputStreamIterator<_InputStream> &r_in, OutputStreamIterator<_OutputStream> &r_out, size_t size) {
+  DPRE(r_in.stream);
+  DPRE(r_out.stream);
+  if (r_in.window.ended()) {
+    return 0;
+  }
+
+  r_out.flushToStream();
+
+  auto v = r_in.window.getRemainder();
+  size_t bufferedSize = min(get<1>(v), size);
+  if (bufferedSize != 0) {
+    r_out.stream->write(get<0>(v), bufferedSize);
+    r_in.window.advance(bufferedSize);
+  }
+  if (bufferedSize == size) {
+    return size;
+  }
+  DA(r_in.window.exhausted());
+
+  return bufferedSize + transfer(*r_in.stream, *r_out.stream, size - bufferedSize);
+}
+
+template<typename _InputStream, typename _OutputStream> size_t transfer (_InputStream &r_in, _OutputStream &r_out, size_t size) {
+  const size_t blockCapacity = 1U << 17;
+  std::unique_ptr<iu8f []> b(new iu8f[min(size, blockCapacity)]);
+
+  size_t moved = 0;
+  while (moved != size) {
+    size_t blockSize = r_in.read(b.get(), min(size - moved, blockCapacity));
+    if (blockSize == numeric_limits<size_t>::max()) {
+      break;
+    }
+    DA(blockSize != 0);
+    r_out.write(b.get(), blockSize);
+    moved += blockSize;
+  }
+  return moved;
+}
+
+template<typename _Stream> AsyncInputStreamIterator<_Stream>::Filler::Filler (AsyncInputStreamIterator<_Stream> &r_i) noexcept : AsyncWaiter(*r_i.executor, r_i.stream->getFd(), false), i(&r_i) {
+}
+
+template<typename _Stream> bool AsyncInputStreamIterator<_Stream>::Filler::attempt () {
+  return i->tryEnsureBuffer();
+}
+
+template<typename _Stream> bool AsyncInputStreamIterator<_Stream>::Filler::await_resume () const {
+  rethrowFailure();
+  return !i->window.ended();
+}
+
+template<typename _Stream> AsyncInputStreamIterator<_Stream>::AsyncInputStreamIterator (EpollExecutor &r_executor, _Stream &r_stream, size_t bufferCapacity) : window(bufferCapacity), stream(&r_stream), executor(&r_executor) {
+}
+
+template<typename _Stream> AsyncInputStreamIterator<_Stream>::AsyncInputStreamIterator (EpollExecutor &r_executor, _Stream &r_stream) : AsyncInputStreamIterator(r_executor, r_stream, BUFSIZ) {
+}
+
+template<typename _Stream> bool AsyncInputStreamIterator<_Stream>::tryEnsureBuffer () {
+  if (!window.exhausted()) {
+    return true;
+  }
+
+  auto v = window.get();
+  iu8f *b = get<0>(v);
+  size_t capacity = get<1>(v);
+  DPRE(b);
+  size_t size = stream->read(b, capacity);
+  DA(size != 0);
+  if (size == wouldBlock) {
+    return false;
+  }
+  if (size == numeric_limits<size_t>::max()) {
+    window.unset();
+    return true;
+  }
+  window.reset(size);
+  return true;
+}
+
+template<typename _Stream> typename AsyncInputStreamIterator<_Stream>::Filler AsyncInputStreamIterator<_Stream>::ensureBuffer () {
+  return Filler(*this);
+}
+
+template<typename _Stream> iu8f AsyncInputStreamIterator<_Stream>::operator* () noexcept {
+  return *window;
+}
+
+template<typename _Stream> AsyncInputStreamIterator<_Stream> &AsyncInputStreamIterator<_Stream>::operator++ () noexcept {
+  ++window;
+  return *this;
+}
+
+template<typename _Stream> AsyncOutputStreamIterator<_Stream>::Flusher::Flusher (AsyncOutputStreamIterator<_Stream> &r_i, bool whenFull) noexcept : AsyncWaiter(*r_i.executor, r_i.stream->getFd(), true), i(&r_i), whenFull(whenFull) {
+}
+
+template<typename _Stream> bool AsyncOutputStreamIterator<_Stream>::Flusher::attempt () {
+  if (whenFull && !i->window.exhausted()) {
+    return true;
+  }
+  return i->tryFlushToStream();
+}
+
+template<typename _Stream> void AsyncOutputStreamIterator<_Stream>::Flusher::await_resume () const {
+  rethrowFailure();
+}
+
+template<typename _Stream> AsyncOutputStreamIterator<_Stream>::AsyncOutputStreamIterator (EpollExecutor &r_executor, _Stream &r_stream, size_t bufferCapacity) : window(bufferCapacity), stream(&r_stream), executor(&r_executor), flushedSize(0) {
+  window.reset(bufferCapacity);
+}
+
+template<typename _Stream> AsyncOutputStreamIterator<_Stream>::AsyncOutputStreamIterator (EpollExecutor &r_executor, _Stream &r_stream) : AsyncOutputStreamIterator(r_executor, r_stream, BUFSIZ) {
+}
+
+template<typename _Stream> bool AsyncOutputStreamIterator<_Stream>::tryFlushToStream () {
+  auto v = window.get();
+  iu8f *b = get<0>(v);
+  size_t capacity = get<1>(v);
+  DPRE(b);
+  size_t advancement = window.advancement();
+  while (flushedSize != advancement) {
+    size_t size = stream->write(b + flushedSize, advancement - flushedSize);
+    if (size == wouldBlock) {
+      return false;
+    }
+    DA(size != 0);
+    flushedSize += size;
+  }
+  flushedSize = 0;
+  window.reset(capacity);
+  return true;
+}
+
+template<typename _Stream> typename AsyncOutputStreamIterator<_Stream>::Flusher AsyncOutputStreamIterator<_Stream>::ensureBuffer () {
+  return Flusher(*this, true);
+}
+
+template<typename _Stream> typename AsyncOutputStreamIterator<_Stream>::Flusher AsyncOutputStreamIterator<_Stream>::flushToStream () {
+  return Flusher(*this, false);
+}
+
+template<typename _Stream> iu8f &AsyncOutputStreamIterator<_Stream>::operator* () noexcept {
+  return *window;
+}
+
+template<typename _Stream> AsyncOutputStreamIterator<_Stream> &AsyncOutputStreamIterator<_Stream>::operator++ () noexcept {
+  ++window;
+  return *this;
+}
+
 template<
   typename _Class, typename _Reference, typename _Iterator
 > RevaluedIterator<_Class, _Reference, _Iterator>::RevaluedIterator (_Iterator &&i) : i(move(i)) {
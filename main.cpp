@@ -1,6 +1,11 @@
 #include "header.hpp"
+#include <algorithm>
 #include <cstring>
+#include <system_error>
 #include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 using core::check;
 using core::string;
@@ -12,6 +17,24 @@ using iterators::InputStreamEndIterator;
 using iterators::OutputStreamIterator;
 using core::OutputIterator;
 using iterators::RevaluedIterator;
+using iterators::FdInputStream;
+using iterators::FdOutputStream;
+using iterators::pump;
+using iterators::UringInputStream;
+using iterators::UringOutputStream;
+using iterators::BufferedWindow;
+using iterators::DirectFdInputStream;
+using iterators::DirectFdOutputStream;
+using iterators::AsyncFdInputStream;
+using iterators::AsyncFdOutputStream;
+using iterators::AsyncInputStreamIterator;
+using iterators::AsyncOutputStreamIterator;
+using iterators::AsyncTask;
+using iterators::EpollExecutor;
+using iterators::FrameReader;
+using iterators::BlockCache;
+using iterators::FdSeekableInputStream;
+using iterators::SeekableStreamIterator;
 using std::vector;
 
 /* -----------------------------------------------------------------------------
@@ -25,6 +48,12 @@ int main (int argc, char *argv[]) {
 
   testInputStreamIterator();
   testOutputStreamIterator();
+  testPump();
+  testUringStreams();
+  testDirectFdStreams();
+  testAsyncStreams();
+  testFrameReader();
+  testSeekableStreamIterator();
   testRevaluedIterator();
 
   return 0;
@@ -250,6 +279,493 @@ template<typename _Stream> void useOutputStream (OutputStreamIterator<_Stream> &
   }
 }
 
+string<iu8f> makeTestData (size_t size) {
+  string<iu8f> data;
+  for (size_t i = 0; i != size; ++i) {
+    data.push_back(static_cast<iu8f>('a' + (i * 7) % 26));
+  }
+  return data;
+}
+
+int makeTempFile () {
+  char path[] = "/tmp/iteratorsXXXXXX";
+  int fd = mkstemp(path);
+  check(fd != -1);
+  unlink(path);
+  return fd;
+}
+
+string<iu8f> readAll (int fd) {
+  check(lseek(fd, 0, SEEK_SET) != -1);
+  return readRest(fd);
+}
+
+string<iu8f> readRest (int fd) {
+  FdInputStream stream(fd);
+  string<iu8f> data;
+  iu8f b[4096];
+  for (size_t size; (size = stream.read(b, sizeof(b))) != numeric_limits<size_t>::max();) {
+    data.append(b, b + size);
+  }
+  return data;
+}
+
+void testPump () {
+  const size_t dataSizes[] = {0U, 1U, 10U, 1000U, 300000U};
+  const size_t preReadCounts[] = {0U, 1U, 7U};
+  for (size_t dataSize : dataSizes) {
+    string<iu8f> data = makeTestData(dataSize);
+    for (size_t bufferCapacity : bufferCapacities) {
+      for (size_t preReadCount : preReadCounts) {
+        if (preReadCount > dataSize) {
+          continue;
+        }
+
+        {
+          TestInputStream inStream{string<iu8f>(data)};
+          TestOutputStream outStream;
+          usePump(inStream, outStream, bufferCapacity, data, preReadCount);
+          check(data, outStream.data);
+        }
+
+        if (bufferCapacity != 4096U) {
+          continue;
+        }
+
+        int inFd = makeTempFile();
+        FdOutputStream(inFd).write(data.data(), data.size());
+        check(lseek(inFd, 0, SEEK_SET) != -1);
+        int outFd = makeTempFile();
+        {
+          FdInputStream inStream(inFd);
+          FdOutputStream outStream(outFd);
+          usePump(inStream, outStream, bufferCapacity, data, preReadCount);
+          check(data, readAll(outFd));
+        }
+
+        if (dataSize < 65536U) {
+          check(lseek(inFd, 0, SEEK_SET) != -1);
+          check(ftruncate(outFd, 0) != -1);
+          check(lseek(outFd, 0, SEEK_SET) != -1);
+          int pipeFds[2];
+          check(pipe(pipeFds) != -1);
+          {
+            FdInputStream inStream(inFd);
+            FdOutputStream outStream(pipeFds[1]);
+            usePump(inStream, outStream, bufferCapacity, data, preReadCount);
+            close(pipeFds[1]);
+          }
+          {
+            FdInputStream inStream(pipeFds[0]);
+            FdOutputStream outStream(outFd);
+            usePump(inStream, outStream, bufferCapacity, data, preReadCount);
+            close(pipeFds[0]);
+          }
+          check(data, readAll(outFd));
+
+          check(lseek(inFd, 0, SEEK_SET) != -1);
+          int socketFds[2];
+          check(socketpair(AF_UNIX, SOCK_STREAM, 0, socketFds) != -1);
+          {
+            FdInputStream inStream(inFd);
+            FdOutputStream outStream(socketFds[1]);
+            usePump(inStream, outStream, bufferCapacity, data, preReadCount);
+            close(socketFds[1]);
+          }
+          check(data, readRest(socketFds[0]));
+          close(socketFds[0]);
+        }
+
+        check(lseek(inFd, 0, SEEK_SET) != -1);
+        check(ftruncate(outFd, 0) != -1);
+        check(lseek(outFd, 0, SEEK_SET) != -1);
+        const iu8f prefix[] = {'x', 'y', 'z'};
+        FdOutputStream(outFd).write(prefix, sizeof(prefix));
+        check(fcntl(outFd, F_SETFL, fcntl(outFd, F_GETFL) | O_APPEND) != -1);
+        {
+          FdInputStream inStream(inFd);
+          FdOutputStream outStream(outFd);
+          usePump(inStream, outStream, bufferCapacity, data, preReadCount);
+          check(string<iu8f>(prefix, prefix + sizeof(prefix)) + data, readAll(outFd));
+        }
+
+        close(inFd);
+        close(outFd);
+      }
+    }
+  }
+}
+
+template<typename _InputStream, typename _OutputStream> void usePump (_InputStream &r_inStream, _OutputStream &r_outStream, size_t bufferCapacity, const string<iu8f> &data, size_t preReadCount) {
+  InputStreamIterator<_InputStream> in(r_inStream, bufferCapacity);
+  OutputStreamIterator<_OutputStream> out(r_outStream, bufferCapacity);
+
+  for (size_t c = 0; c != preReadCount; ++c) {
+    *out++ = *in++;
+  }
+
+  size_t firstSize = (data.size() - preReadCount) / 2;
+  check(firstSize, pump(in, out, firstSize));
+  check(data.size() - preReadCount - firstSize, pump(in, out, numeric_limits<size_t>::max()));
+  check(0U, pump(in, out, numeric_limits<size_t>::max()));
+  check(true, in == InputStreamEndIterator<_InputStream>());
+  out.flushToStream();
+}
+
+void testUringStreams () {
+  const size_t dataSizes[] = {0U, 1U, 1000U, 300000U};
+  const size_t depths[] = {1U, 4U};
+  const size_t uringBufferCapacities[] = {3U, 4096U};
+  for (size_t dataSize : dataSizes) {
+    string<iu8f> data = makeTestData(dataSize);
+    for (size_t depth : depths) {
+      for (size_t uringBufferCapacity : uringBufferCapacities) {
+        int fd = makeTempFile();
+        {
+          UringOutputStream stream(fd, depth, uringBufferCapacity);
+          OutputStreamIterator<UringOutputStream> i(stream, 11U);
+          useOutputStream(i, data);
+          i.flushToStream();
+          stream.flush();
+        }
+        check(static_cast<off_t>(dataSize), lseek(fd, 0, SEEK_CUR));
+        check(data, readAll(fd));
+
+        check(lseek(fd, 0, SEEK_SET) != -1);
+        {
+          UringInputStream stream(fd, depth, uringBufferCapacity);
+          InputStreamIterator<UringInputStream> i(stream, 11U);
+          string<iu8f> r = useInputStream(i, numeric_limits<size_t>::max(), true);
+          check(data, r);
+        }
+        check(static_cast<off_t>(dataSize), lseek(fd, 0, SEEK_CUR));
+        close(fd);
+      }
+    }
+  }
+
+  int pipeFds[2];
+  check(pipe(pipeFds) != -1);
+  string<iu8f> data = makeTestData(1000U);
+  {
+    UringOutputStream stream(pipeFds[1], 4U, 64U);
+    stream.write(data.data(), data.size());
+    stream.flush();
+    close(pipeFds[1]);
+  }
+  {
+    UringInputStream stream(pipeFds[0], 4U, 64U);
+    InputStreamIterator<UringInputStream> i(stream, 11U);
+    check(data, useInputStream(i, numeric_limits<size_t>::max(), true));
+    close(pipeFds[0]);
+  }
+
+  char path[] = "/tmp/iteratorsXXXXXX";
+  int fd = mkstemp(path);
+  check(fd != -1);
+  close(fd);
+  fd = open(path, O_RDONLY);
+  check(fd != -1);
+  unlink(path);
+  {
+    UringOutputStream stream(fd, 4U, 64U);
+    auto checkFails = [] (auto f) {
+      try {
+        f();
+      } catch (std::system_error &e) {
+        check(EBADF, e.code().value());
+        return;
+      }
+      check(false);
+    };
+    try {
+      stream.write(data.data(), data.size());
+    } catch (std::system_error &e) {
+      check(EBADF, e.code().value());
+    }
+    checkFails([&] () { stream.flush(); });
+    checkFails([&] () { stream.write(data.data(), 1U); });
+    checkFails([&] () { stream.flush(); });
+  }
+  check(0, lseek(fd, 0, SEEK_CUR));
+  close(fd);
+}
+
+void testDirectFdStreams () {
+  for (size_t alignment : {1U, 64U, 4096U}) {
+    BufferedWindow window(100U, alignment);
+    check(0U, reinterpret_cast<uintptr_t>(std::get<0>(window.get())) % alignment);
+  }
+
+  char path[] = "/tmp/iteratorsXXXXXX";
+  int fd = mkstemp(path);
+  check(fd != -1);
+  close(fd);
+
+  // Some filesystems (e.g. tmpfs before Linux 6.6) do not support O_DIRECT.
+  fd = open(path, O_RDONLY | O_DIRECT);
+  if (fd == -1) {
+    check(EINVAL, errno);
+    unlink(path);
+    return;
+  }
+  close(fd);
+
+  const size_t dataSizes[] = {0U, 1U, 4096U, 10000U, 300000U};
+  const size_t directBufferCapacities[] = {11U, 4096U, 65536U};
+  for (size_t dataSize : dataSizes) {
+    string<iu8f> data = makeTestData(dataSize);
+    for (size_t bufferCapacity : directBufferCapacities) {
+      {
+        DirectFdOutputStream stream(path);
+        OutputStreamIterator<DirectFdOutputStream> i(stream, bufferCapacity, 4096U);
+        if (bufferCapacity % 4096U == 0) {
+          for (iu8f b : data) {
+            *i++ = b;
+          }
+        } else {
+          useOutputStream(i, data);
+        }
+        i.flushToStream();
+        stream.finish();
+      }
+      {
+        int readFd = open(path, O_RDONLY);
+        check(readFd != -1);
+        check(data, readAll(readFd));
+        close(readFd);
+      }
+      {
+        DirectFdInputStream stream(path);
+        InputStreamIterator<DirectFdInputStream> i(stream, bufferCapacity, 4096U);
+        check(data, useInputStream(i, numeric_limits<size_t>::max(), true));
+      }
+    }
+  }
+
+  unlink(path);
+}
+
+void testAsyncStreams () {
+  string<iu8f> data = makeTestData(100000U);
+  const size_t pairCount = 64;
+  vector<string<iu8f>> rs(pairCount);
+
+  EpollExecutor executor;
+  for (size_t pairI = 0; pairI != pairCount; ++pairI) {
+    int fds[2];
+    if (pairI % 2 == 0) {
+      check(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != -1);
+    } else {
+      check(pipe(fds) != -1);
+    }
+    executor.spawn(writeAsync(executor, fds[1], data, false));
+    executor.spawn(readAsync(executor, fds[0], rs[pairI], false));
+  }
+  executor.run();
+
+  for (const string<iu8f> &r : rs) {
+    check(data, r);
+  }
+
+  // Each end of the socket is read from and written to concurrently, with more
+  // data than fits in the socket buffers.
+  string<iu8f> data0 = makeTestData(1U << 20);
+  string<iu8f> data1 = makeTestData((1U << 20) + 1);
+  string<iu8f> r0, r1;
+  int fds[2];
+  check(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != -1);
+  executor.spawn(writeAsync(executor, fds[0], data0, true));
+  executor.spawn(readAsync(executor, fds[0], r0, true));
+  executor.spawn(writeAsync(executor, fds[1], data1, true));
+  executor.spawn(readAsync(executor, fds[1], r1, true));
+  executor.run();
+  close(fds[0]);
+  close(fds[1]);
+  check(data1, r0);
+  check(data0, r1);
+}
+
+AsyncTask writeAsync (EpollExecutor &r_executor, int fd, const string<iu8f> &data, bool duplex) {
+  AsyncFdOutputStream stream(fd);
+  AsyncOutputStreamIterator<AsyncFdOutputStream> i(r_executor, stream, 64U);
+  for (iu8f b : data) {
+    co_await i.ensureBuffer();
+    *i = b;
+    ++i;
+  }
+  co_await i.flushToStream();
+  if (duplex) {
+    check(shutdown(fd, SHUT_WR) != -1);
+  } else {
+    close(fd);
+  }
+}
+
+AsyncTask readAsync (EpollExecutor &r_executor, int fd, string<iu8f> &r_data, bool duplex) {
+  AsyncFdInputStream stream(fd);
+  AsyncInputStreamIterator<AsyncFdInputStream> i(r_executor, stream, 11U);
+  while (co_await i.ensureBuffer()) {
+    r_data.push_back(*i);
+    ++i;
+  }
+  if (!duplex) {
+    close(fd);
+  }
+}
+
+void testFrameReader () {
+  const size_t frameSizes[] = {0U, 1U, 3U, 2U, 8U, 0U, 5U, 11U, 4U, 5000U, 1U, 300U, 2U};
+  string<iu8f> data = makeTestData(6000U);
+  for (size_t bufferCapacity : bufferCapacities) {
+    string<iu8f> prefixedData;
+    {
+      size_t dataI = 0;
+      for (size_t frameSize : frameSizes) {
+        prefixedData.push_back(static_cast<iu8f>(frameSize >> 8));
+        prefixedData.push_back(static_cast<iu8f>(frameSize & 0xFF));
+        prefixedData.append(data, dataI, frameSize);
+        dataI += frameSize;
+      }
+    }
+
+    for (bool prefixed : {false, true}) {
+      TestInputStream stream{string<iu8f>(prefixed ? prefixedData : data)};
+      InputStreamIterator<TestInputStream> i(stream, bufferCapacity);
+      FrameReader<TestInputStream> reader(i, 5000U);
+
+      size_t dataI = 0;
+      for (size_t frameSize : frameSizes) {
+        auto v = prefixed ? reader.readLengthPrefixed(2U) : reader.read(frameSize);
+        check(std::get<0>(v) != nullptr);
+        check(frameSize, std::get<1>(v));
+        check(data.substr(dataI, frameSize), string<iu8f>(std::get<0>(v), std::get<0>(v) + frameSize));
+        dataI += frameSize;
+      }
+
+      if (!prefixed) {
+        auto v = reader.read(data.size() - dataI + 1);
+        check(nullptr, std::get<0>(v));
+        check(data.size() - dataI, std::get<1>(v));
+      }
+      check(true, i == InputStreamEndIterator<TestInputStream>());
+      auto v = reader.read(1U);
+      check(nullptr, std::get<0>(v));
+      check(0U, std::get<1>(v));
+    }
+  }
+
+  {
+    const iu8f prefixedData[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 'a'};
+    TestInputStream stream{string<iu8f>(prefixedData, prefixedData + sizeof(prefixedData))};
+    InputStreamIterator<TestInputStream> i(stream, 4U);
+    FrameReader<TestInputStream> reader(i, 5000U);
+    bool thrown = false;
+    try {
+      reader.readLengthPrefixed(8U);
+    } catch (std::length_error &) {
+      thrown = true;
+    }
+    check(thrown);
+    check('a', *i);
+  }
+}
+
+struct TestSeekableInputStream {
+  string<iu8f> data;
+  iu64f size;
+  size_t readCount;
+
+  TestSeekableInputStream (string<iu8f> &&data) : data(move(data)), size(this->data.size()), readCount(0) {
+  }
+
+  size_t readAt (iu8f *b, size_t size, iu64f offset) {
+    ++readCount;
+    if (offset >= data.size()) {
+      return 0;
+    }
+    size = std::min(size, static_cast<size_t>(data.size() - offset));
+    memcpy(b, data.data() + offset, size);
+    return size;
+  }
+
+  iu64f getSize () const {
+    return size;
+  }
+};
+
+void testSeekableStreamIterator () {
+  const char *str = "abcdefghijklmnop";
+  for (size_t blockSize : {1U, 3U, 16U, 4096U}) {
+    for (size_t blockCapacity : {1U, 2U, 5U}) {
+      TestSeekableInputStream stream(reinterpret_cast<const iu8f *>(str));
+      BlockCache<TestSeekableInputStream> cache(stream, blockSize, blockCapacity);
+      SeekableStreamIterator<TestSeekableInputStream> begin(cache, 0);
+      SeekableStreamIterator<TestSeekableInputStream> end(cache, cache.getSize());
+
+      useRevaluedRandomAccessIterator(begin, end, str);
+    }
+  }
+
+  string<iu8f> data;
+  for (size_t i = 0; i != 1000000U; ++i) {
+    data.push_back(static_cast<iu8f>(i * 256 / 1000000U));
+  }
+  size_t searchReadCounts[2];
+  for (size_t blockCapacity : {1U, 4U}) {
+    TestSeekableInputStream stream{string<iu8f>(data)};
+    BlockCache<TestSeekableInputStream> cache(stream, 4096U, blockCapacity);
+    SeekableStreamIterator<TestSeekableInputStream> begin(cache, 0);
+    SeekableStreamIterator<TestSeekableInputStream> end(cache, cache.getSize());
+
+    for (iu v = 0; v != 256; ++v) {
+      auto i = std::lower_bound(begin, end, static_cast<iu8f>(v));
+      check(static_cast<size_t>(std::lower_bound(data.begin(), data.end(), static_cast<iu8f>(v)) - data.begin()), static_cast<size_t>(i - begin));
+    }
+    searchReadCounts[blockCapacity == 1U ? 0 : 1] = stream.readCount;
+
+    if (blockCapacity != 1U) {
+      stream.readCount = 0;
+      string<iu8f> r(begin, end);
+      check(data, r);
+      check(stream.readCount < (1000000U + 4095U) / 4096U / 2U);
+    }
+  }
+  check(searchReadCounts[1] < searchReadCounts[0]);
+
+  {
+    TestSeekableInputStream stream{string<iu8f>(data)};
+    BlockCache<TestSeekableInputStream> cache(stream, 4096U, 4U);
+    SeekableStreamIterator<TestSeekableInputStream> begin(cache, 0);
+    stream.data.resize(10000U);
+
+    bool thrown = false;
+    try {
+      begin[20000];
+    } catch (std::runtime_error &) {
+      thrown = true;
+    }
+    check(thrown);
+    check(data[5000], begin[5000]);
+  }
+
+  int fd = makeTempFile();
+  FdOutputStream(fd).write(data.data(), data.size());
+  {
+    FdSeekableInputStream stream(fd);
+    BlockCache<FdSeekableInputStream> cache(stream, 512U, 8U);
+    SeekableStreamIterator<FdSeekableInputStream> begin(cache, 0);
+    SeekableStreamIterator<FdSeekableInputStream> end(cache, cache.getSize());
+
+    check(data.size(), static_cast<size_t>(end - begin));
+    for (size_t i = 0; i < data.size(); i += 7919U) {
+      check(data[i], begin[static_cast<std::ptrdiff_t>(i)]);
+    }
+    check(data, string<iu8f>(begin, end));
+  }
+  close(fd);
+}
+
 // DODGY since indirection returns a value (not a ref), should only be an InputIterator
 struct CapitalisingIterator : public RevaluedIterator<CapitalisingIterator, char, string<char>::const_iterator> {
   CapitalisingIterator (string<char>::const_iterator &&i) : RevaluedIterator(move(i)) {